@@ -16,6 +16,7 @@ public:
 	IntVector sign ;   // Signs for each property in X_A
 	Matrix G_A ;       // Active set Gram matrix.
 	Matrix X_A ;       // Matrix formed by of X for active properties * signs
+	IntVector A_X_A ;  // Properties stored in the columns of X_A.  X_A is updated incrementally from this set.
 	Matrix chol ;       // Cholesky decomposition of G_A.
 	Vector G_A_Inv_I ;  // G_A^-1 * I
 	double A_A ;        // Normalization (I G_A^-1 I)^-1/2
@@ -38,11 +39,26 @@ public:
 	bool use_precondition  ; // If true, use preconditioning in conjugate gradient.
 	bool distributed_solver ;  // If true, use a distributed G_A matrix and cholesky solver.
 	double obj_func_val ;  // Latest value of the objective function.
+	bool use_screen ;     // If true, only update correlations of properties that survive screening.
+	bool safe_screen ;    // If true, screen with the safe rule instead of the sequential strong rule.
+	bool screen_built ;   // If true, the current screen is in use.
+	IntVector screen ;    // Properties that survived screening, including the active set, in increasing order.
+	IntVector in_screen ; // 1 for properties in screen, 0 for those screened out.
+	Vector mu_screen ;    // The prediction when the screen was built.
+	double screen_lambda ;  // The screen is rebuilt when C_max drops below this value.
+	double screen_c_max ;   // C_max when the screen was built.
+	Vector col_norm ;     // L2 norm of each column of X, used by the safe rule.
+	IntVector fit_row ;   // 1 for rows used in the fit, 0 for held out rows.  Empty if all rows are used.
+	int nfit ;            // The number of rows used in the fit.
+	Vector col_shift ;    // Shift of each column of X for this fit, applied as X is used.  Empty if X is used as is.
+	Vector col_scale ;    // Scale of each column of X for this fit, applied after col_shift.
+	string file_tag ;     // Added to output file names, e.g. ".fold1".
 	int iterations ;    // The number of solver iterations.
 	ofstream trajfile ;  // Output file for the trajectory (solution history).
 
-  DLARS(Matrix &Xin, Vector &yin, double lamin): X(Xin), y(Xin.dim1), mu(Xin.dim1),
-		beta(Xin.dim2), c(Xin.dim2), A(0),  exclude(Xin.dim2, 0), sign(0), lambda(lamin)
+  DLARS(Matrix &Xin, Vector &yin, double lamin, string tag = ""): X(Xin), y(Xin.dim1), mu(Xin.dim1),
+		beta(Xin.dim2), c(Xin.dim2), A(0),  exclude(Xin.dim2, 0), sign(0), A_X_A(0), lambda(lamin),
+		fit_row(0), col_shift(0), col_scale(0), file_tag(tag)
 		{
 			do_lasso = false ;
 			gamma_lasso = 1.0e20 ;
@@ -57,13 +73,18 @@ public:
 			solve_succeeded = true ;
 			solve_con_grad = false ;
 			use_precondition = false ;
+			use_screen = false ;
+			safe_screen = false ;
+			screen_built = false ;
 			
 			iterations = 0 ;
+			nfit = X.dim1 ;
 
 			X_A.distribute(Xin) ;
+			X_A.use_col_slots() ;
 
 			if ( RANK == 0 ) {
-				trajfile.open("traj.txt") ;
+				trajfile.open("traj" + file_tag + ".txt") ;
 				trajfile.precision(12) ;
 				trajfile << scientific ;
 			}
@@ -82,6 +103,13 @@ public:
 			}
 		}
 
+	inline double x_get(int j, int k) const
+		// Element j,k of X, with the column shift and scale of this fit applied.
+		{
+			if ( col_shift.dim == 0 ) return X.get(j,k) ;
+			return ( X.get(j,k) - col_shift.get(k) ) / col_scale.get(k) ;
+		}
+
 	int iteration() ;
 	void build_G_A(Matrix &G_A_in, bool increment_G_A)	;
 	bool build_G_A_here() ;
@@ -96,8 +124,20 @@ public:
 	double sq_error() ;
 	void objective_func() ;
 	void correlation() ;
+	void build_screen() ;
+	void check_screen(const IntVector &props) ;
+	int expand_screen(double gamma_step) ;
 	void build_X_A() ;
 	int restart(string filename) ;
+	void warm_start(string filename) ;
+	void hold_out_rows(int first, int last) ;
+	void mask_rows(Vector &vec) ;
+	double held_out_sq_error(const Vector &y_all) ;
+	void normalize_fit_rows(const Vector &feature_weights) ;
+	void x_dot(Vector &out, const Vector &in) ;
+	void x_dot_transpose(Vector &out, const Vector &in) ;
+	void x_dot_transpose_cols(Vector &out, const Vector &in, const IntVector &cols) ;
+	void x_column_norms(Vector &out) ;
 	void broadcast_solution() ;
 	bool solve_G_A_con_grad() ;
 	bool build_u_A() ;
@@ -14,6 +14,13 @@ public:
 	bool distributed ;		// Is this matrix distributed over processes ?
 	int row_start, row_end ;	// Starting and ending row for parallel calculations.
 	int num_rows ;		// Number of rows stored on this process.
+	bool sparse ;		// Are the local rows stored in compressed sparse row form (row_ptr, col_idx, vals) ?
+	long long *row_ptr ;	// Sparse storage: start of each local row in col_idx and vals, num_rows+1 entries.
+	int *col_idx ;		// Sparse storage: column of each stored element, increasing within a row.
+	double *vals ;		// Sparse storage: value of each stored element.
+	bool col_slots ;	// Is each column stored contiguously in a slot of num_rows elements ?  See use_col_slots.
+	int slot_cap ;		// Slot storage: number of column slots allocated.
+	int *slot ;		// Slot storage: slot holding each column.
 
 	bool cholesky(Matrix &chol) ;
 	bool cholesky_distribute(Matrix &chol) ;	
@@ -23,6 +30,22 @@ public:
 	void cholesky_sub_distribute(Vector &x, const Vector &b) ;
 	bool cholesky_add_row_distribute(const Matrix &chol0, const Vector &newr)	;
 	bool cholesky_remove_row_dist(int id )	;
+	void use_col_slots() ;
+	void add_col(const Matrix &src, int col, double fac) ;
+	void remove_col(int col) ;
+	void negate_col(int col) ;
+	void dot_transpose_cols(Vector &out, const Vector &in, const IntVector &cols) const ;
+	void column_norms(Vector &out) const ;
+
+	static bool is_binary_file(const char *filename) ;
+	static bool is_sparse_file(const char *filename) ;
+	void read_binary(const char *filename, bool is_distributed) ;
+	void read_binary_rows(const char *filename) ;
+	void read_sparse_rows(std::ifstream &file, const char *filename, long long file_row_start, long long nrows) ;
+	void clear_sparse() ;
+	double get_sparse(int i, int j) const ;
+	void set_sparse(int i, int j, double val) ;
+	void gather_rows(Vector &out) const ;
 	
 	int rank_from_row(int j) const {
 		for ( int k = 0 ; k < NPROCS ; k++ ) {
@@ -50,6 +73,13 @@ public:
 		row_start = matin.row_start ;
 		row_end = matin.row_end ;
 		num_rows = matin.num_rows ;
+		sparse = false ;		// The copy is always dense, with row storage.
+		row_ptr = NULL ;
+		col_idx = NULL ;
+		vals = NULL ;
+		col_slots = false ;
+		slot_cap = 0 ;
+		slot = NULL ;
 
 		mat = new double[num_rows * dim2] ;
 		shift = new double[dim2] ;
@@ -77,6 +107,13 @@ public:
 			row_end = dim1 - 1 ;
 			num_rows = dim1 ;
 			distributed = false ;
+			sparse = false ;
+			row_ptr = NULL ;
+			col_idx = NULL ;
+			vals = NULL ;
+			col_slots = false ;
+			slot_cap = 0 ;
+			slot = NULL ;
 			for ( int j = 0 ; j < dim2 ; j++ ) {
 				shift[j] = 0.0 ;
 				scale[j] = 1.0 ;
@@ -90,6 +127,13 @@ public:
 			dim2 = d2 ;
 			shift = new double[d2] ;
 			scale = new double[d2] ;
+			sparse = false ;
+			row_ptr = NULL ;
+			col_idx = NULL ;
+			vals = NULL ;
+			col_slots = false ;
+			slot_cap = 0 ;
+			slot = NULL ;
 			for ( int j = 0 ; j < dim2 ; j++ ) {
 				shift[j] = 0.0 ;
 				scale[j] = 1.0 ;
@@ -118,11 +162,20 @@ public:
 			row_end = -1 ;
 			num_rows = 0 ;
 			distributed = false ;
+			sparse = false ;
+			row_ptr = NULL ;
+			col_idx = NULL ;
+			vals = NULL ;
+			col_slots = false ;
+			slot_cap = 0 ;
+			slot = NULL ;
 		}
 	~Matrix() {
 		delete [] mat ;
 		delete [] shift ;
 		delete [] scale ;
+		delete [] slot ;
+		clear_sparse() ;
 		dim1 = 0 ;
 		dim2 = 0 ;
 	}
@@ -139,6 +192,7 @@ public:
 			if ( mat != NULL ) {
 				delete [] mat ;
 			}
+			clear_sparse() ;
 			shift = new double[dim2] ;
 			scale = new double[dim2] ;
 
@@ -304,6 +358,13 @@ public:
 		string mat_ext = str_filename.substr(found+1) ;
 		str_filename = str_filename.substr(0,found+1) ;
 		sprintf(matFilename2, "%s%04d.%s", str_filename.c_str(), my_file, mat_ext.c_str()) ;
+
+		if ( is_binary_file(matFilename2) || is_sparse_file(matFilename2) ) {
+			// Binary container written by chimes_lsq with # AMATFMT # BINARY or SPARSE.
+			read_binary_rows(matFilename2) ;
+			return ;
+		}
+		
 		ifstream matfile(matFilename2);		
 		if (!matfile.good()) {
 			cerr << "error opening matrix file " << matFilename2 << endl;
@@ -313,6 +374,7 @@ public:
 		if ( mat != NULL ) {
 			delete [] mat ;
 		}
+		clear_sparse() ;
 		mat = new double[num_rows * dim2];
 
 		if ( shift != NULL ) {
@@ -347,11 +409,21 @@ public:
 
 	void realloc(int d1, int d2) 
 		{
-			if ( dim1 > 0 && dim2 > 0 ) {
+			if ( dim1 > 0 && ( dim2 > 0 || col_slots ) ) {
 				delete [] mat ;
 				delete [] scale ;
 				delete [] shift ;
 			}
+			clear_sparse() ;
+			if ( col_slots ) {
+				// Keep slot storage, with no spare slots.
+				delete [] slot ;
+				slot_cap = d2 ;
+				slot = new int[d2] ;
+				for ( int j = 0 ; j < d2 ; j++ ) {
+					slot[j] = j ;
+				}
+			}
 			scale = new double[d2] ;
 			shift = new double[d2] ;
 			if ( ! distributed ) {
@@ -370,7 +442,7 @@ public:
 			}
 			dim1 = d1 ;
 			dim2 = d2 ;
-			mat = new double[num_rows * d2] ;
+			mat = new double[(long long) num_rows * d2] ;
 		}
 
 		void resize(int d1, int d2)
@@ -451,6 +523,8 @@ public:
 				stop_run(1) ;
 			}
 #endif						
+			if ( sparse ) return get_sparse(i, j) ;
+			if ( col_slots ) return mat[(long long) slot[j] * num_rows + (i-row_start)] ;
 			return(mat[(i-row_start) * dim2 + j]) ;
 		}
 	inline void set(int i, int j, double val) 
@@ -465,6 +539,14 @@ public:
 				stop_run(1) ;
 			}
 #endif						
+			if ( sparse ) {
+				set_sparse(i, j, val) ;
+				return ;
+			}
+			if ( col_slots ) {
+				mat[(long long) slot[j] * num_rows + (i-row_start)] = val ;
+				return ;
+			}
 			mat[(i-row_start) * dim2 + j] = val	 ;
 		}
 	inline void setT(int i, int j, double val) {
@@ -509,6 +591,14 @@ public:
 		if ( vals.dim != dim1 ) {
 			cout << "Error in scale_rows: dimensions did not match" << endl ;
 		}
+		if ( sparse ) {
+			for ( int j = row_start ; j <= row_end ; j++ ) {
+				for ( long long l = row_ptr[j-row_start] ; l < row_ptr[j-row_start+1] ; l++ ) {
+					this->vals[l] *= vals.get(j) ;
+				}
+			}
+			return ;
+		}
 
 #ifdef USE_OPENMP		
 #pragma omp parallel for shared(vals) default(none)
@@ -527,6 +617,16 @@ public:
 		if ( vals.dim != dim2 ) {
 			cout << "Error in scale_columns: dimensions did not match" << endl ;
 		}
+		if ( sparse ) {
+			long long nnz = row_ptr[num_rows] ;
+			for ( long long l = 0 ; l < nnz ; l++ ) {
+				this->vals[l] *= vals.get(col_idx[l]) ;
+			}
+			for ( int k = 0 ; k < dim2 ; k++ ) {
+				scale[k] /= vals.get(k) ;
+			}
+			return ;
+		}
 
 #ifdef USE_OPENMP		
 #pragma omp parallel for shared(vals) default(none)
@@ -611,17 +711,26 @@ public:
 #endif // USE_MPI
 		}
 
-	void normalize()
+	void normalize(int hold_first = 0, int hold_last = -1)
 	// Normalize matrix to according to Eq. 1.1
+	// Rows hold_first to hold_last are left out when finding the shift and scale, which
+	// are still applied to all rows.  Used to normalize a cross-validation fold by its training rows.
 		{
+			if ( sparse ) {
+				// Shifting the columns would fill in the matrix.
+				if ( RANK == 0 ) cout << "Error: a sparse matrix can not be normalized" << endl ;
+				stop_run(1) ;
+			}
 			Vector tmp(dim2, 0.0) ;
+			int nuse = dim1 - ( hold_last - hold_first + 1 ) ;
 			
 			for ( int j = 0 ; j < dim2 ; j++ ) {
 				double sum = 0.0 ;
 #ifdef USE_OPENMP		
-#pragma omp parallel for shared(j) reduction(+:sum) default(none)
+#pragma omp parallel for shared(j,hold_first,hold_last) reduction(+:sum) default(none)
 #endif						
 				for ( int k = row_start ; k <= row_end ; k++ ) {
+					if ( hold_first <= k && k <= hold_last ) continue ;
 					sum += get(k, j) ;
 				}
 
@@ -636,7 +745,7 @@ public:
 #endif			
 			
 			for ( int j = 0 ; j < dim2 ; j++ ) {
-				shift[j] /= dim1 ;
+				shift[j] /= nuse ;
 				for ( int k = row_start ; k <= row_end ; k++ ) {
 					double val = get(k, j) - shift[j] ;
 					set(k, j, val) ;
@@ -645,6 +754,7 @@ public:
 			for ( int j = 0 ; j < dim2 ; j++ ) {
 				tmp.set(j, 0.0) ;
 				for ( int k = row_start ; k <= row_end ; k++ ) {
+					if ( hold_first <= k && k <= hold_last ) continue ;
 					tmp.add(j, get(k, j) * get(k,j) );
 				}
 			}
@@ -797,7 +907,30 @@ public:
 				cout << "Array dimension mismatch" << endl ;
 				stop_run(1) ;
 			}
-			if ( ! distributed ) {
+			if ( sparse ) {
+				// Only the stored elements of each row contribute.
+				for ( int j = row_start ; j <= row_end ; j++ ) {
+					double sum = 0.0 ;
+					for ( long long l = row_ptr[j-row_start] ; l < row_ptr[j-row_start+1] ; l++ ) {
+						sum += vals[l] * in.get(col_idx[l]) ;
+					}
+					out.set(j, sum) ;
+				}
+				if ( distributed ) gather_rows(out) ;
+			} else if ( col_slots ) {
+				// Add up the local rows of each column in turn.
+				for ( int j = row_start ; j <= row_end ; j++ ) {
+					out.set(j, 0.0) ;
+				}
+				for ( int k = 0 ; k < dim2 ; k++ ) {
+					const double *col = mat + (long long) slot[k] * num_rows ;
+					double ink = in.get(k) ;
+					for ( int j = 0 ; j < num_rows ; j++ ) {
+						out.add(j + row_start, col[j] * ink) ;
+					}
+				}
+				if ( distributed ) gather_rows(out) ;
+			} else if ( ! distributed ) {
 #ifdef USE_BLAS			
 				cblas_dgemv(CblasRowMajor, CblasNoTrans, dim1, dim2, 1.0,
 							mat, dim2, in.vec, 1, 0.0, out.vec, 1) ;
@@ -825,28 +958,8 @@ public:
 					out.set(j, sum) ;
 				}
 #endif // USE_BLAS
-				
-#ifdef USE_MPI
-				Vector out2(dim1, 0.0) ;		// Temporary array to collect out.vec values.
-				IntVector countv(NPROCS) ;	// The number of items to receive from each process.
-				IntVector displs(NPROCS) ;	// Storage displacements in out2 for each process.
-
-				int count = row_end - row_start + 1 ;
-
-				MPI_Allgather(&count, 1, MPI_INT, countv.vec, 1, MPI_INT, MPI_COMM_WORLD) ;
-
-				displs.set(0,0) ;
-				for ( int j = 1 ; j < NPROCS ; j++ ) {
-					displs.set(j, displs.get(j-1) + countv.get(j-1) ) ;
-				}
-				MPI_Allgatherv(&(out.vec[row_start]), countv.get(RANK),
-								 MPI_DOUBLE, out2.vec, countv.vec, displs.vec, MPI_DOUBLE, MPI_COMM_WORLD) ;
-				
-				for ( int j = 0 ; j < dim1 ; j++ ) {
-					out.set(j, out2.get(j) ) ;
-				}
+				gather_rows(out) ;
 			}
-#endif				
 		}
 
 	void cholesky_invert(Matrix &out)
@@ -876,7 +989,45 @@ public:
 				cout << "Array dimension mismatch" << endl ;
 				stop_run(1) ;
 			}
-			if ( ! distributed ) {
+			if ( sparse ) {
+				// Scatter each stored element of the local rows.
+				Vector sumv(dim2,0.0) ;			
+				for ( int j = row_start ; j <= row_end ; j++ ) {
+					double inj = in.get(j) ;
+					for ( long long l = row_ptr[j-row_start] ; l < row_ptr[j-row_start+1] ; l++ ) {
+						sumv.add(col_idx[l], vals[l] * inj) ;
+					}
+				}
+#ifdef USE_MPI
+				if ( distributed ) {
+					MPI_Allreduce(sumv.vec, out.vec, dim2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD) ;
+					return ;
+				}
+#endif
+				for ( int j = 0 ; j < dim2 ; j++ ) {
+					out.set(j, sumv.get(j)) ;
+				}
+			} else if ( col_slots ) {
+				// Each element of out is the dot product of one stored column with the local rows of in.
+				Vector sumv(dim2,0.0) ;
+				for ( int k = 0 ; k < dim2 ; k++ ) {
+					const double *col = mat + (long long) slot[k] * num_rows ;
+					double sum = 0.0 ;
+					for ( int j = 0 ; j < num_rows ; j++ ) {
+						sum += col[j] * in.get(j + row_start) ;
+					}
+					sumv.set(k, sum) ;
+				}
+#ifdef USE_MPI
+				if ( distributed ) {
+					MPI_Allreduce(sumv.vec, out.vec, dim2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD) ;
+					return ;
+				}
+#endif
+				for ( int j = 0 ; j < dim2 ; j++ ) {
+					out.set(j, sumv.get(j)) ;
+				}
+			} else if ( ! distributed ) {
 #ifdef USE_BLAS
 				// Perform matrix-vector multiply on all rows.
 				cblas_dgemv(CblasRowMajor, CblasTrans, dim1, dim2, 1.0,
@@ -1111,6 +1262,12 @@ public:
 	double memory()
 	// Returns memory used on the current rank in MB.
 	{
+		if ( sparse ) {
+			return( (double) ( (num_rows + 1) * sizeof(long long) + row_ptr[num_rows] * (sizeof(int) + sizeof(double)) ) / (1024.0 * 1024.0) ) ;
+		}
+		if ( col_slots ) {
+			return( (double) num_rows * slot_cap * 8 / (1024.0 * 1024.0) ) ;
+		}
 		return( (double) (row_end - row_start + 1) * dim2 * 8 / (1024.0 * 1024.0) ) ;
 	}
 
@@ -137,13 +137,15 @@ public:
 			// cout <<  "Last line: " + line << endl ;
 		}
 
-	void normalize()
+	void normalize(int hold_first = 0, int hold_last = -1)
+	// Subtract the mean.  Elements hold_first to hold_last are left out of the mean.
 		{
 			shift = 0 ;
 			for ( int i = 0 ; i < dim ; i++ ) {
+				if ( hold_first <= i && i <= hold_last ) continue ;
 				shift += vec[i] ;
 			}
-			shift /= dim;
+			shift /= dim - ( hold_last - hold_first + 1 ) ;
 			for ( int i = 0 ; i < dim ; i++ ) {
 				vec[i] -= shift ;
 			}
@@ -10,12 +10,13 @@ echo ""
 # Run with:
 # ./install.sh
 # or
-# ./install.sh <debug option (0 or 1)> <install prefix (full path)> <verbosity option (0 or 1 or 2 or 3)> <MPI option (0 or 1)>
+# ./install.sh <debug option (0 or 1)> <install prefix (full path)> <verbosity option (0 or 1 or 2 or 3)> <MPI option (0 or 1)> <OpenMP option (0 or 1)>
 
 DEBUG=${1-0}  # False (0) by default; if false, compiles with -O3, otherwise, uses -g
 PREFX=${2-""} # Empty by default
 VERBO=${3-1}  # Verbosity set to 1 by default, 0 gives minimal output, 3 gives minimal with DEBUG_CHEBY output, 4 gives all output
 DOMPI=${4-1}  # Compile with MPI support by default
+DOOMP=${5-0}  # Compile without OpenMP threading by default
 
 
 echo "Attempting to perform a fresh install"
@@ -142,6 +143,12 @@ else
         my_flags="${my_flags} -DUSE_MPI=0" 
 fi
 
+if [ $DOOMP -eq 1 ] ;then
+        my_flags="${my_flags} -DUSE_OPENMP=1" 
+else
+        my_flags="${my_flags} -DUSE_OPENMP=0" 
+fi
+
 echo "compiling with flags: $my_flags"
 
 
@@ -2,6 +2,7 @@
 #define _A_MATRIX_H
 
 #include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -17,6 +18,24 @@ struct STENSOR
 	double YZ;
 };
 
+// Location of the rows written for one frame in a rank's temporary output files.  With
+// # FRMSCHD # DYNAMIC, frames are processed in no particular order, and these records are
+// used to write the rows back out in frame order.  All members are long long so that
+// records can be exchanged as MPI_LONG_LONG arrays.
+
+struct FRAME_ROWS
+{
+	long long FRAME;		// Frame index.  Charge constraint rows sort after all frames.
+	long long RANK;			// Rank holding the rows
+	long long ROW_START;		// First row in that rank's temporary files
+	long long NROWS;
+	long long A_BYTES[2];		// Offset and length in the text A file
+	long long B_BYTES[2];		// Offset and length in the b file
+	long long BLAB_BYTES[2];	// Offset and length in the b-labeled file
+	long long NA_BYTES[2];		// Offset and length in the natoms file
+	long long LABEL_BYTES[2];	// Offset and length in the label section of the binary A file
+};
+
 class A_MAT
 {
 
@@ -28,6 +47,29 @@ class A_MAT
 	// { (Param-1_O--O), (Param-2_O--O), (Param-3_O--O), (Param-4_O--O), 
 	//   (Param-1_O--H), (Param-2_O--H), (Param-3_O--H), (Param-4_O--H), 
 	//   (Param-1_H--H), (Param-2_H--H), (Param-3_H--H), (Param-4_H--H)	}
+	//
+	// Binary A matrix container (# AMATFMT # BINARY), written to A.bin, or A.%04d.bin with SPLITFI.
+	// All values are in native byte order. The 64-byte header is:
+	//
+	//   char[8] "CHMSAMAT", int32 version, int32 ncols,
+	//   int64 nrows (rows in this file), int64 row_start (global index of the first row), int64 total_rows,
+	//   int32 short-range columns, int32 charge columns, int32 energy offset columns, int32 unused, int64 unused
+	//
+	// followed by nrows*ncols doubles (A, row-major), nrows doubles (b), and nrows newline-terminated
+	// row labels (the same labels as b-labeled.txt).
+	//
+	// Sparse A matrix container (# AMATFMT # SPARSE) uses the same file names and header, with magic 
+	// "CHMSSPRS" and the last int64 holding the number of stored (non-zero) entries.  Each row of A is 
+	// stored as int32 count, int32 columns[count] (increasing), double values[count], and the b values and 
+	// row labels follow as above.
+	//
+	// Normal equations (# AMATFMT # GRAM), written to gram.bin.  A is never stored; the 64-byte header is:
+	//
+	//   char[8] "CHMSGRAM", int32 version, int32 ncols, int64 nrows,
+	//   int32 short-range columns, int32 charge columns, int32 energy offset columns, int32 unused,
+	//   double b^T b, int64 unused[2]
+	//
+	// followed by ncols*ncols doubles (A^T A, row-major) and ncols doubles (A^T b).
 	
 	
 	public:
@@ -36,7 +78,26 @@ class A_MAT
 	vector<string>          ATOM_TYPES;	 // What are their chemical symbols
 	vector<int>             NO_ATOMS_OF_TYPE;// How many atoms of each type are there?
 	
-	vector<vector<XYZ> >	FORCES; 	// originally "A_MATRIX"       ... [#frames][#atoms][#fittingparameters]
+	// Force derivatives (originally "A_MATRIX"), stored as structure-of-arrays: FORCE_ARENA holds
+	// the X, Y and Z planes back to back, so every A matrix row is contiguous. The arena only grows, 
+	// so it is allocated once for the largest frame and reused.
+	//
+	// An atom only has non-zero derivatives for the parameters of interactions involving its own atom 
+	// type, so each row holds just those columns (CSR-style, with one sorted column list shared by all 
+	// atoms of a type). FORCE_SLOT maps a column to its position in the row, or -1 if the column is 
+	// not stored for that type. Without a pattern from SET_FORCE_PATTERN, every column is stored.
+	
+	int                     FORCE_ATOMS;	// Atoms in the current frame
+	int                     FORCE_PARAMS;	// Short-ranged fitting parameters per row
+	vector<double>          FORCE_ARENA;	
+	
+	vector<int>             FORCE_COLS;	// Columns stored for each atom type, back to back
+	vector<int>             FORCE_COLS_START;// [#atomtypes+1] -> start of each type's columns in FORCE_COLS
+	vector<int>             FORCE_SLOT;	// [#atomtypes][#fittingparameters] -> position in the row, or -1
+	vector<int>             FORCE_TYPE;	// [#atoms] -> atom type index, for the current frame
+	vector<size_t>          FORCE_START;	// [#atoms] -> start of the atom's row within a plane
+	size_t                  FORCE_PLANE;	// Values per plane for the current frame
+	
 	vector<STENSOR>         STRESSES;	// new; stresses       ... originally tacked on to "A_MATRIX" ... [#frames][#fittingparameters]
 	vector<double>          FRAME_ENERGIES;	// new; frame energies ... originally tacked on to "A_MATRIX" ... [#frames][#fittingparameters]
 	vector<vector<double> > ATOM_ENERGIES;	// new; per-atom energies      ... [#frames][#atoms] [#fittingparameters]
@@ -46,27 +107,101 @@ class A_MAT
 	vector<vector<XYZ> >   CHARGES;	        // originally "COULOMB_FORCES" ... [#frames][#pairtypes][#atoms]
 
 	ofstream fileA, fileb, fileb_labeled, filena;
+	fstream  fileAbin;		// Binary A matrix container, used instead of fileA when AMATFMT is BINARY or SPARSE.
 
 	A_MAT();
 	~A_MAT();
 	
 	void INITIALIZE_NATOMS  (int ATOMS, vector<string> & FRAME_ATOMTYPES, vector<PAIRS> & ATOM_PAIRS);
-	void INITIALIZE_FORCES  (int ATOMS, int PARAMS);
+	void SET_FORCE_PATTERN  (int NTYPES, int PARAMS, const vector<vector<int> > & TYPE_COLS);
+	void SET_FORCE_PATTERN  (struct JOB_CONTROL & CONTROLS, vector<PAIRS> & ATOM_PAIRS, vector<int> & INT_PAIR_MAP, class CLUSTER_LIST & TRIPS, class CLUSTER_LIST & QUADS);
+	void INITIALIZE_FORCES  (int ATOMS, int PARAMS, const vector<int> & ATOMTYPE_IDX);
+	void RESERVE_FORCES     (int ATOMS, int PARAMS);
+	void EXPAND_FORCE_ROW   (int COMP, int ATOM, double * OUT) const;
+	
+	// Stored derivatives for component COMP (0, 1, 2 = X, Y, Z) of atom ATOM. Entry i belongs
+	// to column FORCE_ROW_COLS(ATOM)[i].
+	
+	inline double * FORCE_ROW(int COMP, int ATOM)
+	{
+		return FORCE_ARENA.data() + COMP * FORCE_PLANE + FORCE_START[ATOM];
+	}
+	inline const double * FORCE_ROW(int COMP, int ATOM) const
+	{
+		return FORCE_ARENA.data() + COMP * FORCE_PLANE + FORCE_START[ATOM];
+	}
+	inline int FORCE_ROW_LEN(int ATOM) const
+	{
+		return FORCE_COLS_START[FORCE_TYPE[ATOM]+1] - FORCE_COLS_START[FORCE_TYPE[ATOM]];
+	}
+	inline const int * FORCE_ROW_COLS(int ATOM) const
+	{
+		return FORCE_COLS.data() + FORCE_COLS_START[FORCE_TYPE[ATOM]];
+	}
+	inline const int * FORCE_ROW_SLOTS(int ATOM) const
+	{
+		return FORCE_SLOT.data() + (size_t) FORCE_TYPE[ATOM] * FORCE_PARAMS;
+	}
+	
+	// Positions [LO, HI) of ATOM's row that hold columns [COL0, COL0+NCOLS).  Columns are
+	// stored in order, so these are contiguous.
+	
+	inline void FORCE_ROW_SPAN(int ATOM, int COL0, int NCOLS, int & LO, int & HI) const
+	{
+		const int * COLS = FORCE_ROW_COLS(ATOM);
+		int         LEN  = FORCE_ROW_LEN(ATOM);
+		
+		LO = lower_bound(COLS, COLS + LEN, COL0)         - COLS;
+		HI = lower_bound(COLS, COLS + LEN, COL0 + NCOLS) - COLS;
+	}
+	
 	void INITIALIZE_ENERGIES(int ATOMS, int PARAMS, bool FRAME_ENER);
 	void INITIALIZE_STRESSES(int PARAMS, bool DIAG_STRESS, bool ALL_STRESS);
 	void INITIALIZE_CHARGES (int FF_PAIRS,int ATOMS);
 	void PRINT_FRAME(const struct JOB_CONTROL &CONTROLS, const class FRAME &SYSTEM, const vector<class PAIRS> & ATOM_PAIRS, const vector<struct CHARGE_CONSTRAINT> & CHARGE_CONSTRAINTS, int N);
 	void PRINT_CONSTRAINTS(const struct JOB_CONTROL &CONTROLS,const vector<struct CHARGE_CONSTRAINT> & CHARGE_CONSTRAINTS, int NPAIRS);
 	void CLEANUP_FILES(bool SPLIT_FILES);
-	void OPEN_FILES(const JOB_CONTROL &CONTROLS);
+	void OPEN_FILES(const JOB_CONTROL &CONTROLS, int NPAIRS);
 	void INITIALIZE(JOB_CONTROL &CONTROLS, FRAME& SYSTEM, int NPAIRS, vector<PAIRS> & ATOM_PAIRS);
 	
 	private:
 	
 	void add_col_of_ones(string item, bool DO_ENER, ofstream & OUTFILE);
 	void write_natoms(ofstream & OUTFILE);
+	void print_frame_rows(const struct JOB_CONTROL &CONTROLS, const class FRAME &SYSTEM, int N, int my_file);
+	void write_row(string item, bool DO_ENER, double bval, const string & label);
+	void store_row(double bval, const string & label);
+	void write_binary_header(fstream & OUTFILE, long long nrows, long long row_start, long long total_rows, long long nnz);
+	long long a_section_bytes(long long nrows, long long nnz) const;
+	void finish_binary_file(int start, int total);
+	void merge_binary_files(int total);
+	void finish_gram(int total);
+	void begin_frame_rows(long long frame);
+	void end_frame_rows();
+	void write_frame_order();
 	int data_count;
 	int param_count;
+
+	bool           binary_output;	// Write the A matrix as a binary container ?
+	bool           sparse_output;	// ... storing only the non-zero entries of each row ?
+	long long      sparse_nnz;	// Entries stored so far in the sparse container.
+	int            short_cols;	// Number of short-ranged columns in each row.
+	int            charge_cols;	// Number of charge (Coulomb) columns in each row.
+	int            ener_cols;	// Number of per-atom-type energy offset columns in each row.
+	vector<double> row_buf;		// Row under construction for binary output.
+	vector<double> binary_b;	// b values for rows written to the binary container.
+	vector<string> binary_labels;	// Row labels for rows written to the binary container.
+
+	bool           gram_output;	// Accumulate the normal equations instead of writing A ?
+	vector<double> gram_ata;	// A^T A, param_count x param_count, row-major.
+	vector<double> gram_atb;	// A^T b
+	double         gram_btb;	// b^T b
+	vector<int>    nz_idx;		// Non-zero columns of the current row.
+	vector<double> nz_val;		// ... and their values, for the sparse container.
+
+	bool               frame_order;	// Rows are written to temporary files, and re-ordered by frame in CLEANUP_FILES ?
+	vector<FRAME_ROWS> frame_rows;	// Where each frame's rows went in the temporary files.
+	long long          label_bytes;	// Bytes of row labels stored so far for the binary A file.
 	
 };
 
@@ -7,6 +7,109 @@
 
 #define MAX_BODIEDNESS 4
 
+#define PAIR_BATCH_SIZE 64	// Pairs per call of Cheby::set_polys_batch
+
+// Evaluation of Tn and Tnd for rlen >= s_minim, specialized on the distance transformation 
+// and, for common orders, on the polynomial order; see Cheby::poly_kernel.
+
+typedef void (*CHEBY_POLY_KERNEL)(double rlen, double x_diff, double x_avg, double lambda, double deriv_const, 
+								  int snum, double *Tn, double *Tnd) ;
+
+
+// A block of 2-body pairs whose Chebyshev polynomials are evaluated together by
+// Cheby::set_polys_batch. TN and TND are stored power-major (TN[n*N + p]), so the
+// recursion over n runs across contiguous pairs and can be vectorized.
+
+struct PAIR_BATCH
+{
+	int N ;					// Number of pairs in the batch
+	vector<int>    TYPE ;	// Pair type index
+	vector<int>    ATOM ;	// Second atom of the pair
+	vector<double> RLEN ;
+	vector<XYZ>    RAB ;
+	vector<double> X ;		// Transformed distance
+	vector<double> DX_DR ;	// Derivative of X wrt. RLEN
+	vector<double> TN ;
+	vector<double> TND ;
+
+	// Allocate space for PAIR_BATCH_SIZE pairs with up to MAX_SNUM polynomials each.
+	void RESIZE(int MAX_SNUM)
+	{
+		N = 0 ;
+		TYPE .resize(PAIR_BATCH_SIZE) ;
+		ATOM .resize(PAIR_BATCH_SIZE) ;
+		RLEN .resize(PAIR_BATCH_SIZE) ;
+		RAB  .resize(PAIR_BATCH_SIZE) ;
+		X    .resize(PAIR_BATCH_SIZE) ;
+		DX_DR.resize(PAIR_BATCH_SIZE) ;
+		TN   .resize((MAX_SNUM+2) * PAIR_BATCH_SIZE) ;
+		TND  .resize((MAX_SNUM+2) * PAIR_BATCH_SIZE) ;
+	}
+
+	void ADD(int PAIR_TYPE, int A2, double R, const XYZ & R_AB)
+	{
+		TYPE[N] = PAIR_TYPE ;
+		ATOM[N] = A2 ;
+		RLEN[N] = R ;
+		RAB [N] = R_AB ;
+		N++ ;
+	}
+
+	// Polynomial n of pair p.
+	double T (int n, int p) const { return TN [n*N + p] ; }
+	double TD(int n, int p) const { return TND[n*N + p] ; }
+} ;
+
+
+
+// Per-frame cache of the pair terms of the 3- and 4-body interactions.  Every atom pair of
+// NEIGHBORS::LIST_MB_PAIRS is evaluated (distance, polynomials and cutoff function) once for
+// each PAIR_SET it is used with, rather than once for every triplet or quadruplet containing it.
+// A set of lower polynomial order is served by an entry of higher order, since the lower orders
+// are a prefix of the higher ones.  Entries are resolved and evaluated by Cheby::cache_3b_pairs 
+// and Cheby::cache_4b_pairs.
+
+struct PAIR_SET
+// Parameters a pair is evaluated with.
+{
+	int    PAIR_TYPE ;
+	int    SNUM ;
+	double S_MINIM ;
+	double S_MAXIM ;
+	double X_AVG ;
+	double X_DIFF ;
+	FCUT * FORCE_CUTOFF ;
+	CHEBY_POLY_KERNEL POLYS ;	// Chosen by Cheby::poly_kernel when the set is created
+} ;
+
+struct PAIR_CACHE
+{
+	int STRIDE ;			// Polynomials stored per entry
+	int N_EVALUATED ;		// Entries before this one have been evaluated
+
+	vector<PAIR_SET> SETS ;
+	vector<int>      SET_3B ;	// [(triplet type*3 + pair)*pair types + pair type] -> set, or -1
+	vector<int>      SET_4B ;	// [(quadruplet type*6 + pair)*pair types + pair type] -> set, or -1
+
+	// Per atom pair of NEIGHBORS::LIST_MB_PAIRS
+
+	vector<int>    FIRST ;		// First entry of the pair, or -1
+	vector<double> RLEN ;
+	vector<XYZ>    RAB ;
+
+	// Per entry
+
+	vector<int>    PAIR ;
+	vector<int>    SET ;
+	vector<int>    NEXT ;		// Next entry of the same pair, or -1
+	vector<char>   PROCEED ;	// Is the pair within the cutoffs of the set?
+	vector<double> FCUT ;
+	vector<double> FCUT_DERIV ;
+	vector<double> TN ;		// [entry*STRIDE + n], only set if PROCEED
+	vector<double> TND ;
+
+	PAIR_CACHE() : STRIDE(0), N_EVALUATED(0) {}
+} ;
 
 
 class Cheby
@@ -36,7 +139,11 @@ public:
 	void Deriv_4B(A_MAT & FRAME_A_MATRIX, int n_3b_cheby_terms, CLUSTER_LIST &QUADS);
 
 	// Calculate the many-body Chebyshev force
-	void Force_all(CLUSTER_LIST &TRIPS, CLUSTER_LIST &QUADS);
+	void Force_all(CLUSTER_LIST &TRIPS, CLUSTER_LIST &QUADS, Force_split PART = Force_split::ALL);
+
+	// Forget the cached 3- and 4-body pair terms.  Needed only if the coordinates change 
+	// while the Cheby object is in use; normally one is created per frame.
+	void Clear_pair_cache();
 
 	// Calculate the 3-body Chebyshev force
 	void Force_3B(CLUSTER_LIST &TRIPS);
@@ -77,6 +184,9 @@ public:
 
 	static void set_cheby_params(double sminim, double smaxim, double lambda, Cheby_trans cheby_type, double &xminim, double &xmaxim, double &xdiff, double &xavg);
 
+	// Return the polynomial kernel for a transformation and order.
+	static CHEBY_POLY_KERNEL poly_kernel(Cheby_trans TRANS, int SNUM);
+
 
 private:
 
@@ -87,6 +197,9 @@ private:
 	void set_polys(int index, double *Tn, double *Tnd, const double rlen, double x_diff, double x_avg, 
 				   int snum, double smin);
 
+	// Evaluate the 2-body Chebyshev polynomials of a block of pairs.
+	void set_polys_batch(PAIR_BATCH & BATCH) ;
+
 	// Evaluate Chebyshev polynomials when rlen is less than s_minim.
 	void set_polys_out_of_range(int index, double *Tn, double *Tnd, double rlen, double x_diff, double x_avg, int SNUM,
 								double s_minim) ;
@@ -102,6 +215,30 @@ private:
 	// Set the chebyshev power for each atom pair in the triplet.
 	inline void set_3b_powers(const TRIPLETS & FF_3BODY, const vector<int> &pair_index, int POWER_SET,
 							  int & pow_ij, int & pow_ik, int & pow_jk ) ;
+
+	// Resolve the type, pair indices, and column offset of entries FIRST to LAST of the flat 3-body list.
+	void type_3b_interactions(CLUSTER_LIST &TRIPS, int FIRST, int LAST);
+
+	// Resolve the type, pair indices, and column offset of entries FIRST to LAST of the flat 4-body list.
+	void type_4b_interactions(CLUSTER_LIST &QUADS, int FIRST, int LAST);
+
+	// Pair terms of the 3- and 4-body interactions, shared within a frame.
+	PAIR_CACHE MB_CACHE ;
+
+	// Resolve the pair cache entries of typed entries FIRST to LAST of the flat 3-body list, and evaluate new ones.
+	void cache_3b_pairs(CLUSTER_LIST &TRIPS, int FIRST, int LAST);
+
+	// Resolve the pair cache entries of typed entries FIRST to LAST of the flat 4-body list, and evaluate new ones.
+	void cache_4b_pairs(CLUSTER_LIST &QUADS, int FIRST, int LAST);
+
+	// Return the pair cache set for pair SLOT of cluster type TYPE, adding it if needed.
+	int pair_cache_set(vector<int> & SET_OF, CLUSTER & CLUSTER_TYPE, int TYPE, int SLOT, int NSLOTS, int PAIR_TYPE, int SNUM);
+
+	// Return the pair cache entry of atom pair PAIR for SET, adding it if needed.
+	int pair_cache_entry(int PAIR, int SET);
+
+	// Evaluate the pair cache entries added since the last call.
+	void eval_pair_cache();
 };
 
 
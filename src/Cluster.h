@@ -185,7 +185,7 @@ CLUSTER(int natom, int npair):
 	 NPAIRS = npair;
 	 N_CFG_CONTRIB = 0;
 	 N_TRUE_ALLOWED_POWERS = 0;
-	 FORCE_CUTOFF.TYPE = FCUT_TYPE::CUBIC;	
+	 FORCE_CUTOFF.set_type(FCUT_TYPE::CUBIC);
   }
 
   
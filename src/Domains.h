@@ -0,0 +1,56 @@
+// Spatial domain decomposition for chimes_md.
+//
+// The primitive cell is split into a GRID.X x GRID.Y x GRID.Z grid of bricks in fractional
+// coordinates, one per process.  A process owns (integrates) the atoms in its brick and holds
+// halo copies of the atoms within the neighbor list cutoff (largest force field cutoff plus
+// RCUT_PADDING) of it.  Per-atom arrays keep their global indexing; only the entries of held
+// atoms are current on a given process.  Halos are built by staged swaps with the neighboring
+// bricks along each cell vector, so edge and corner atoms arrive in the later stages.  Periodic
+// images are still provided by the ghost layers.
+//
+// Only the force work is divided among processes.  Memory is not: every process still allocates
+// the per-atom arrays of the whole system, so the largest system is the same as without DOMDCMP.
+//
+// Ownership and halos are only rebuilt with the neighbor list, so the neighbor list skin also
+// bounds how far an atom may stray from its brick.
+
+#ifndef _DOMAINS_H
+#define _DOMAINS_H
+
+class DOMAINS
+{
+public:
+
+	XYZ_INT GRID ;		// Number of processes along each cell vector.
+	XYZ_INT CELL ;		// Grid position of this process.
+
+	void INITIALIZE    (FRAME & SYSTEM, JOB_CONTROL & CONTROLS, NEIGHBORS & NEIGHBOR_LIST) ;
+	void REDISTRIBUTE  (FRAME & SYSTEM, NEIGHBORS & NEIGHBOR_LIST) ;	// Move atoms to their new owners and rebuild the halos.
+	void FORWARD_COORDS(FRAME & SYSTEM) ;				// Refresh halo coordinates from their owners.
+	void SUM_FORCES    (FRAME & SYSTEM) ;				// Return halo forces to their owners, sum energy and virial.
+	void GATHER        (FRAME & SYSTEM) ;				// Copy coordinates, velocities and forces of all atoms to rank 0.
+	double MAX_ALL     (double VAL) ;				// Largest VAL over all processes.
+
+	DOMAINS() ;
+
+private:
+
+	bool FIRST_CALL ;
+
+	vector<bool> IS_LOCAL ;			// Is the atom owned by this process?
+	vector<bool> IS_HELD ;			// Is the atom owned or held as a halo copy?
+
+	// Halo swaps, in the order they were built.  RECV_LIST entries of -1 mark atoms
+	// that were already held when they arrived.
+
+	vector<int>          SEND_RANK ;
+	vector<int>          RECV_RANK ;
+	vector<vector<int> > SEND_LIST ;
+	vector<vector<int> > RECV_LIST ;
+
+	int  rank_of(int CX, int CY, int CZ) ;
+	void fractional(BOX & BOXDIM, const XYZ & ATOM, double S[3]) ;
+	void exchange(int SEND_TO, vector<double> & SEND_BUF, int RECV_FROM, vector<double> & RECV_BUF) ;
+} ;
+
+#endif
@@ -9,21 +9,26 @@ enum class FCUT_TYPE // Contains allowed force cut-off types.
 	TERSOFF
 } ;
 
+class FCUT ;
+
+// A cut-off function evaluation specialized on the cut-off type and power; see FCUT::set_kernel.
+typedef void (*FCUT_KERNEL)(const FCUT & CUT, double & fcut, double & fcut_deriv, const double rlen, const double rmin, const double rmax) ;
+
 class FCUT 
 {
 public:
 
 	double OFFSET; 
 
-
-	// power used in the cutoff function.
-	int  POWER = 3 ;
-
-	// Type of cutoff-function employed.
-	FCUT_TYPE TYPE ;
-
 	// set the type of the cutoff function.
 	void set_type(string s) ;
+	void set_type(FCUT_TYPE t) ;
+
+	// set the power used in the cutoff function.
+	void set_power(int p) ;
+
+	inline FCUT_TYPE get_type()  const { return TYPE  ; }
+	inline int       get_power() const { return POWER ; }
 
 	// Default constructor.
 	FCUT() ;
@@ -32,7 +37,10 @@ public:
 	string to_string() ;
 
 	// Evaluate the cut-off function.
-	void get_fcut(double & fcut, double & fcut_deriv, const double rlen, const double rmin, const double rmax) ;
+	inline void get_fcut(double & fcut, double & fcut_deriv, const double rlen, const double rmin, const double rmax)
+	{
+		KERNEL(*this, fcut, fcut_deriv, rlen, rmin, rmax) ;
+	}
 
 	// Decide whether to proceed with a pair interaction.
 	bool PROCEED(const double & rlen, const double & rmin, const double & rmax) ;
@@ -45,6 +53,21 @@ public:
 
 	// Print an entry into the force field header file.
 	void print_header(ostream &header) ;
+
+private:
+
+	// power used in the cutoff function.
+	int  POWER = 3 ;
+
+	// Type of cutoff-function employed.  TYPE and POWER are only changed through the setters,
+	// so that KERNEL always matches them.
+	FCUT_TYPE TYPE ;
+
+	// Chosen once by set_kernel, so get_fcut does not branch on the type per pair.
+	FCUT_KERNEL KERNEL ;
+
+	// Choose the evaluation kernel for TYPE and POWER.
+	void set_kernel() ;
 } ;
 
 #endif
@@ -0,0 +1,70 @@
+// Smooth particle-mesh Ewald for the k-space part of the Ewald sum.
+//
+// Charges are spread onto a mesh along the cell vectors with cardinal B-splines, the mesh is
+// convolved with the k-space influence function by FFT, and gradients of the resulting potential
+// are interpolated back to the atoms.  See Essmann et al., JCP 103, 8577 (1995).  The cost is
+// O(N log N) and the cell may be triclinic.
+//
+// Usage: SETUP for the current cell, SPLINES for the atoms, then SPREAD, CONVOLVE and GRADIENT
+// for each set of charges.  The influence function is only rebuilt when the cell changes.
+
+#ifndef _PME_H
+#define _PME_H
+
+#include<complex>
+
+class PME_FFT
+// Mixed-radix complex FFT of one length (factors 2, 3 and 5), unnormalized.
+{
+public:
+
+	void INITIALIZE(int LENGTH) ;
+	void TRANSFORM (complex<double> * DATA, int SIGN) ;	// In place; SIGN is +1 or -1 in the exponent.
+
+private:
+
+	int N ;
+	vector<int>             FACTORS ;
+	vector<complex<double> > ROOTS ;	// exp(2 pi i t / N)
+	vector<complex<double> > WORK ;
+
+	void recurse(complex<double> * OUT, const complex<double> * IN, int LEN, int STRIDE, int LEVEL, int SIGN) ;
+} ;
+
+class PME
+{
+public:
+
+	int ORDER ;		// B-spline interpolation order (even).
+	int MESH[3] ;		// Mesh points along each cell vector.
+
+	void   SETUP   (BOX & BOXDIM, double ALPHA, double ACCURACY) ;	// Choose the mesh and influence function for this cell.
+	void   SPLINES (FRAME & SYSTEM, int FIRST, int LAST) ;		// B-spline weights of atoms FIRST..LAST.
+	void   SPREAD  (const vector<double> & Q, int FIRST, int LAST) ;	// Charge mesh of atoms FIRST..LAST.
+	void   SUM_MESH() ;							// Sum the charge mesh over all processes.
+	double CONVOLVE(vector<XYZ> * VIRIAL) ;				// Replace the charge mesh by its potential; return the energy.
+	void   GRADIENT(int ATOM, XYZ & GRAD) ;				// Potential gradient at ATOM.
+
+	PME() ;
+
+private:
+
+	double ALPHA ;
+	double ACCURACY ;
+	double CELL[9] ;			// Cell vectors the influence function was built for.
+	double RECIP[9] ;			// Reciprocal vectors (rows), so that s = RECIP r.
+
+	vector<double>           INFLUENCE ;	// B(m) exp(-pi^2 m^2/alpha^2)/(pi V m^2) at each mesh point.
+	vector<double>           Q_MESH ;	// Charges, then potential.
+	vector<complex<double> > C_MESH ;
+	PME_FFT                  FFT[3] ;
+
+	vector<int>    BASE ;			// First mesh point of each atom along each cell vector.
+	vector<double> THETA ;			// B-spline weights of each atom, [atom][dim][ORDER].
+	vector<double> DTHETA ;			// and their derivatives.
+
+	void bspline(double W, double * M, double * DM) ;
+	void fft3d(int SIGN) ;
+} ;
+
+#endif
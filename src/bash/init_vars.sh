@@ -45,7 +45,8 @@ function init_test_vars
 
 
     LSQ_MAKE_JOBS='lsq2
-                   tatb'
+                   tatb
+                   amatfmt'
 
 	MD_JOBS='carbon-penalty
 		 h2o-2bcheby
@@ -80,7 +81,9 @@ function init_test_vars
 		verify-scramble 
 		h2o-4bcheby-numforce 
 		verify-relabel 
-		verify-relabel.2'
+		verify-relabel.2
+		h2o-2bcheby-domdcmp
+		special3b-respa'
 
 	LSQ_FORCE_JOBS='h2o-3bcheby 
 		h2o-4bcheby 
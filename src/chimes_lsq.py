@@ -61,7 +61,7 @@ def main():
     # Algorithms requiring sklearn.
     sk_algos = ["lasso", "ridge", "lassolars", "lars", "ridgecv"] ;
 
-    if args.algorithm in sk_algos:
+    if args.algorithm in sk_algos and not is_gram_file(args.A):
         from sklearn import linear_model
         from sklearn import preprocessing
         
@@ -82,6 +82,8 @@ def main():
     #################################
 
     # Use genfromtxt to avoid parsing large files. Note that the AL driver does not use split matrices
+
+    GRAM = False    # True if the normal equations (A^T A, A^T b) were read in place of A.
     
     if (args.active  and not args.split_files) or ((args.algorithm == "dlasso") and not args.split_files): 
     
@@ -91,11 +93,27 @@ def main():
         nlines = b.shape[0]
 
     elif ( (not args.split_files) and (not args.read_output) ) :
-        A       = numpy.genfromtxt(args.A , dtype='float')
-        nlines  = A.shape[0] 
-        np      = A.shape[1] 
-        b       = numpy.genfromtxt(args.b, dtype='float') 
-        nlines2 = b.shape[0] 
+        if is_gram_file(args.A):
+            # Normal equations (# AMATFMT # GRAM).  A and b are never formed.
+            ATA, ATb, btb, nlines = read_gram_file(args.A)
+            GRAM    = True
+            A       = None
+            b       = None
+            np      = ATA.shape[0]
+            nlines2 = nlines
+        else:
+            if is_binary_amat(args.A):
+                # Binary container (# AMATFMT # BINARY) holds both A and b.
+                A, b, labels = read_binary_amat(args.A)
+            elif is_sparse_amat(args.A):
+                # Sparse container (# AMATFMT # SPARSE).  The fitting algorithms here need a dense A.
+                A, b, labels = read_sparse_amat(args.A)
+            else:
+                A   = numpy.genfromtxt(args.A , dtype='float')
+                b   = numpy.genfromtxt(args.b, dtype='float') 
+            nlines  = A.shape[0] 
+            np      = A.shape[1] 
+            nlines2 = b.shape[0] 
 
         if ( nlines != nlines2 ):
             print ("Error: the number of lines in the input files do not match\n")
@@ -118,6 +136,10 @@ def main():
             np     = "undefined"
             nlines = b.shape[0]
             
+    if GRAM and ( DO_WEIGHTING or args.algorithm not in ['svd', 'ridge'] ):
+        print ("Error: normal equation files can only be solved by the svd or ridge algorithms, without weights")
+        exit(1)
+
     # Sanity check weight dimensions        
     
     if DO_WEIGHTING and not args.split_files:
@@ -164,7 +186,27 @@ def main():
     # Solve the matrix equation
     #################################
 
-    if args.algorithm == 'svd':
+    if args.algorithm == 'svd' and GRAM:
+
+        # The eigenvalues of A^T A are the squared singular values of A, so the
+        # same cutoff as the SVD of A is applied to sqrt(eigenvalue).
+
+        print ('! svd algorithm used (normal equations)')
+
+        lam, V = scipy.linalg.eigh(ATA)
+        D      = numpy.sqrt(numpy.clip(lam, 0.0, None))
+        dmax   = numpy.max(D)
+
+        eps   = args.eps * dmax
+        keep  = D > eps
+        nvars = numpy.count_nonzero(keep)
+
+        print ("! eps (= args.eps*dmax)          =  %11.4e" % eps)        
+        print ("! SVD regularization factor      = %11.4e" % args.eps)
+
+        x = dot(V[:,keep], dot(transpose(V[:,keep]), ATb) / lam[keep])
+
+    elif args.algorithm == 'svd':
         
         # Make the scipy call
         
@@ -213,12 +255,17 @@ def main():
 
     elif args.algorithm == 'ridge':
         print ('! ridge regression used')
-        reg = linear_model.Ridge(alpha=args.alpha,fit_intercept=False)
 
-        # Fit the data.
-        reg.fit(A,b)
+        if GRAM:
+            # Same objective as linear_model.Ridge: |Ax-b|^2 + alpha |x|^2
+            x = scipy.linalg.solve(ATA + args.alpha * numpy.identity(np), ATb, assume_a='pos')
+        else:
+            reg = linear_model.Ridge(alpha=args.alpha,fit_intercept=False)
 
-        x = reg.coef_
+            # Fit the data.
+            reg.fit(A,b)
+
+            x = reg.coef_
         nvars = np
         print ("! Ridge alpha = %11.4e" % args.alpha)
 
@@ -279,18 +326,22 @@ def main():
 
     # If split_files, A is not read in ...This conditional should really be set by the algorithm, since many set  y themselves...  
       
-    if ( (not args.split_files) and (not args.read_output) and (not args.active ) and (args.algorithm != "dlasso") ):
+    if ( (not args.split_files) and (not args.read_output) and (not args.active ) and (args.algorithm != "dlasso") and (not GRAM) ):
         y=dot(A,x)
         
     Z=0.0
 
-    # Put calculated forces in force.txt
+    if GRAM:
+        # No predicted forces without A.  |Ax-b|^2 = x^T A^T A x - 2 x^T A^T b + b^T b
+        Z = dot(x, dot(ATA, x)) - 2.0 * dot(x, ATb) + btb
+    else:
+        # Put calculated forces in force.txt
     
-    yfile = open("force.txt", "w")
+        yfile = open("force.txt", "w")
     
-    for a in range(0,len(b)):
-        Z = Z + (y[a] - b[a]) ** 2.0
-        yfile.write("%13.6e\n"% y[a]) 
+        for a in range(0,len(b)):
+            Z = Z + (y[a] - b[a]) ** 2.0
+            yfile.write("%13.6e\n"% y[a]) 
 
     bic = float(nlines) * log(Z/float(nlines)) + float(nvars) * log(float(nlines))
 
@@ -656,6 +707,112 @@ def count_nonzero_vars(x):
     return np
 
 
+# Header of the binary A matrix container written by chimes_lsq.  See A_Matrix.h.
+
+AMAT_BINARY_HEADER = numpy.dtype([('magic',     'S8'),
+                                  ('version',   '=i4'),
+                                  ('ncols',     '=i4'),
+                                  ('nrows',     '=i8'),
+                                  ('row_start', '=i8'),
+                                  ('total_rows','=i8'),
+                                  ('layout',    '=i4', (4,)),
+                                  ('unused',    '=i8')])
+
+def is_binary_amat(fname):
+## True if fname is a binary A matrix container (# AMATFMT # BINARY).
+    try:
+        with open(fname, "rb") as f:
+            return f.read(8) == b"CHMSAMAT"
+    except IOError:
+        return False
+
+
+def is_sparse_amat(fname):
+## True if fname is a sparse A matrix container (# AMATFMT # SPARSE).
+    try:
+        with open(fname, "rb") as f:
+            return f.read(8) == b"CHMSSPRS"
+    except IOError:
+        return False
+
+
+def read_sparse_amat(fname):
+## Read a sparse A matrix container into a dense A.  Returns A, b, and the row labels.
+    with open(fname, "rb") as f:
+        hdr = numpy.fromfile(f, dtype=AMAT_BINARY_HEADER, count=1)[0]
+        if hdr['version'] != 1:
+            print ("Error: unsupported sparse A matrix version in " + fname)
+            exit(1)
+        nrows = int(hdr['nrows'])
+        ncols = int(hdr['ncols'])
+        A     = numpy.zeros((nrows,ncols),dtype=float)
+        for i in range(0, nrows):
+            count = numpy.fromfile(f, dtype='=i4', count=1)
+            if count.shape[0] != 1:
+                break
+            cols = numpy.fromfile(f, dtype='=i4', count=int(count[0]))
+            A[i,cols] = numpy.fromfile(f, dtype='=f8', count=int(count[0]))
+        b      = numpy.fromfile(f, dtype='=f8', count=nrows)
+        labels = f.read().decode().split('\n')[:nrows]
+    if ( b.shape[0] != nrows ):
+        print ("Error: " + fname + " is truncated")
+        exit(1)
+    return A, b, labels
+
+
+# Header of the normal equation file written by chimes_lsq.  See A_Matrix.h.
+
+GRAM_BINARY_HEADER = numpy.dtype([('magic',     'S8'),
+                                  ('version',   '=i4'),
+                                  ('ncols',     '=i4'),
+                                  ('nrows',     '=i8'),
+                                  ('layout',    '=i4', (4,)),
+                                  ('btb',       '=f8'),
+                                  ('unused',    '=i8', (2,))])
+
+def is_gram_file(fname):
+## True if fname is a normal equation file (# AMATFMT # GRAM).
+    try:
+        with open(fname, "rb") as f:
+            return f.read(8) == b"CHMSGRAM"
+    except IOError:
+        return False
+
+
+def read_gram_file(fname):
+## Read a normal equation file.  Returns A^T A, A^T b, b^T b, and the number of rows in A.
+    with open(fname, "rb") as f:
+        hdr = numpy.fromfile(f, dtype=GRAM_BINARY_HEADER, count=1)[0]
+        if hdr['version'] != 1:
+            print ("Error: unsupported normal equation file version in " + fname)
+            exit(1)
+        ncols = int(hdr['ncols'])
+        ATA   = numpy.fromfile(f, dtype='=f8', count=ncols*ncols).reshape((ncols,ncols))
+        ATb   = numpy.fromfile(f, dtype='=f8', count=ncols)
+    if ( ATb.shape[0] != ncols ):
+        print ("Error: " + fname + " is truncated")
+        exit(1)
+    return ATA, ATb, float(hdr['btb']), int(hdr['nrows'])
+
+
+def read_binary_amat(fname):
+## Read a binary A matrix container.  Returns A, b, and the row labels.
+    with open(fname, "rb") as f:
+        hdr = numpy.fromfile(f, dtype=AMAT_BINARY_HEADER, count=1)[0]
+        if hdr['version'] != 1:
+            print ("Error: unsupported binary A matrix version in " + fname)
+            exit(1)
+        nrows  = int(hdr['nrows'])
+        ncols  = int(hdr['ncols'])
+        A      = numpy.fromfile(f, dtype='=f8', count=nrows*ncols).reshape((nrows,ncols))
+        b      = numpy.fromfile(f, dtype='=f8', count=nrows)
+        labels = f.read().decode().split('\n')[:nrows]
+    if ( A.shape[0] != nrows or b.shape[0] != nrows ):
+        print ("Error: " + fname + " is truncated")
+        exit(1)
+    return A, b, labels
+
+
 #############################################
 #############################################
 # DLARS wrapper
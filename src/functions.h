@@ -26,6 +26,8 @@
 #include<algorithm>
 #include<assert.h>
 #include<map>
+#include<unordered_map>
+#include<chrono>
 
 using namespace std;
 
@@ -75,6 +77,15 @@ enum class Cheby_fix {
 	SMOOTH
 } ;
 
+// Force terms evaluated by ZCalc.  The r-RESPA integrator in chimes_md evaluates the
+// 2-body and Ewald real-space terms (FAST) every step, and the 3-body, 4-body and
+// Ewald k-space terms (SLOW) every CONTROLS.RESPA_INNER steps.
+enum class Force_split {
+	ALL,
+	FAST,
+	SLOW
+} ;
+
 // Include Chimes files here.
 
 #include "Fcut.h"
@@ -136,6 +147,10 @@ public:
 	double FREQ_UPDATE_BAROSTAT;  // Barostat time constant... defaults to 1000
 	bool   USE_NUMERICAL_PRESS;   // Replaces num_pressure... Whether to calculate pressures by finite difference.
 	bool   USE_NUMERICAL_STRESS;   // Whether to calculate the stress tensor by finite difference.	
+	bool   DOMAIN_DECOMP;	      // If true, split the MD cell among processes by position instead of replicating it (see Domains.h).
+	XYZ_INT DOMAIN_GRID;	      // Processes along each cell vector for DOMAIN_DECOMP... zeros let the code choose.
+	int    RESPA_INNER;	      // r-RESPA: steps per evaluation of the slow (many-body and k-space) forces... 1 disables it.
+	bool   USE_PME;		      // If true, use smooth particle-mesh Ewald for the k-space sums (see PME.h).
 
 	// For penalty-function related exit
 
@@ -149,6 +164,7 @@ public:
 	int    FREQ_DFTB_GEN;	      // Replaces gen_freq... How often to write the gen file.
 	string TRAJ_FORMAT;	      // .gen, .xyzf, or .lammps (currently)
 	bool   SPLIT_FILES ;	      // If TRUE, do not concatenate A matrix files for LSQ.
+	string AMAT_FORMAT ;	      // Format of the LSQ A matrix output: TEXT (A.txt), BINARY (A.bin), SPARSE (A.bin, non-zeros only), or GRAM (normal equations, gram.bin)
 	int    FREQ_BACKUP;	      // How often to write backup files for restart.
 	bool   PRINT_VELOC;	      // If true, write out the velocities 
 	bool   RESTART; 	      // If true, read a restart file.
@@ -163,6 +179,7 @@ public:
 	bool   WRAP_COORDS;	      // Should coordinates be wrapped?
 	bool   FORDFTB;	              // Write a special output file for DFTB+ to read in? (default = false)
 	int    SKIP_FRAMES ;       // Should parallel processing of LSQ frames skip (>= 1) or be contiguous (0) ?
+	string FRAME_SCHEDULE ;    // How LSQ frames are shared between processes: STATIC (by SKIP_FRAMES) or DYNAMIC (largest-first, on demand)
 	
 	// Controls for how to construct the initial system, if desired
 
@@ -245,11 +262,13 @@ public:
 		USE_3B_CHEBY = false;	// Replaces if_3b_cheby... If true, calculate 3-Body Chebyshev interaction.
 		USE_4B_CHEBY = false;	//If true, calculate 4-Body Chebyshev interaction.
 		SPLIT_FILES  = false ;
+		AMAT_FORMAT  = "TEXT" ;
 		TOT_ALL_PARAMS = 0 ;
 		SERIAL_CHIMES = false ;
 		USE_KILL_LEN = false;
 		//IO_ECONS_VAL = 0.0;
 		SKIP_FRAMES = 0 ;
+		FRAME_SCHEDULE = "STATIC" ;
 		
 		FCUT_LINE = "CUBIC";
 		FIT_ENER_EVER = false ;
@@ -267,6 +286,11 @@ public:
 		NSTRESS           = -1;
 		NENER             = -1;
 		FORDFTB           = false;
+
+		DOMAIN_DECOMP     = false;
+		DOMAIN_GRID.X = DOMAIN_GRID.Y = DOMAIN_GRID.Z = 0;
+		RESPA_INNER       = 1;
+		USE_PME           = false;
 		
 	}
 	void LSQ_SETUP(int npairs, int no_atom_types) ; // Set up JOB_CONTROL for LSQ calculation.
@@ -357,6 +381,26 @@ public:
    // Updates RAB to contain distance vectors	 
 	 void GET_DISTANCE(const XYZ & ATOM1, const XYZ & ATOM2, XYZ & RAB, bool USE_MIC);
 
+   // Fractional (cell vector) coordinates of ATOM, without wrapping
+	 void GET_FRACTIONAL(const XYZ & ATOM, double S[3]);
+
+   // Distance between opposite cell faces along each cell vector
+	 void GET_HEIGHTS(double H[3]);
+
+};
+
+// Atom type tables and line buffers that FRAME::READ_XYZF reuses for every frame it reads.
+// The tables only depend on the atom types and pairs, so they are built once per run.
+
+struct XYZF_READER
+{
+	unordered_map<string,int> TYPE_IDX;		// Atom type index of each atom type name.  The first match wins, as for a linear search.
+	vector<int>               TYPE_CHARGE_PAIR;	// Atom pair holding the charge of each atom type, or -1 if none.
+	string                    HEADER;		// Box line of the current frame
+	string                    LINE;			// Atom line of the current frame
+	vector<const char *>      TOKENS;		// Start of each token in HEADER
+
+	XYZF_READER(const JOB_CONTROL &CONTROLS, const vector<PAIRS> &ATOM_PAIRS, const vector<string> &TMP_ATOMTYPE);
 };
 
 class FRAME
@@ -405,13 +449,16 @@ public:
 	 vector<XYZ>	VELOCITY_NEW;
 	 vector<XYZ>     VELOCITY_ITER;
 
+	 vector<int>     LOCAL_ATOMS;	// Atoms owned by this process: all of them unless the MD run is domain-decomposed.
+	 vector<int>     HELD_ATOMS;	// Atoms with current coordinates on this process: LOCAL_ATOMS plus any halo copies.
+
 	 // Update ghost atom positions.
 
 	 void 		update_ghost(int n_layers, bool UPDATE_WRAPDIM);
 	 inline int 	get_atomtype_idx(int atom);
 
 	 void SET_NATOMS_OF_TYPE();
-	 void READ_XYZF(ifstream &TRAJ_INPUT, const JOB_CONTROL &CONTROLS, const vector<PAIRS> &ATOM_PAIRS, const vector<string> &TMP_ATOMTYPE, int i);
+	 void READ_XYZF(ifstream &TRAJ_INPUT, const JOB_CONTROL &CONTROLS, const vector<PAIRS> &ATOM_PAIRS, XYZF_READER &READER, int i);
 	 void build_layers(int N_LAYERS) ;
 };
 
@@ -423,6 +470,14 @@ struct CHARGE_CONSTRAINT
 	double		   FORCE;
 };
 	
+class INTERACTION_PAIR
+// An atom pair of the 3- or 4-body interaction lists.  RAB is taken as a2 - a1.
+{
+	public:
+		int a1;  // Atom 1.
+		int a2;  // Atom 2.
+};
+
 class INTERACTION_3B
 // A 3-body interaction.
 {
@@ -433,6 +488,17 @@ class INTERACTION_3B
 		int a1;  // Atom 1.
 		int a2;  // Atom 2.
 		int a3;  // Atom 3.
+		
+		int pair[3];       // Index of ij, ik, and jk in NEIGHBORS::LIST_MB_PAIRS.
+		
+		// Resolved per frame by Cheby::type_3b_interactions and Cheby::cache_3b_pairs.
+		
+		int type;          // Triplet type index, or -1 if excluded.
+		int vstart;        // First column of the triplet type, relative to the first 3-body column.
+		int pair_type[3];  // Pair type of ij, ik, and jk.
+		int pair_idx[3];   // Pair index of ij, ik, and jk within the triplet type.
+		
+		int entry[3];      // Cheby pair cache entry of ij, ik, and jk.
 };
 
 class INTERACTION_4B
@@ -446,6 +512,17 @@ class INTERACTION_4B
 		int a2;  // Atom 2.
 		int a3;  // Atom 3.
 		int a4;  // Atom 4.
+		
+		int pair[6];       // Index of ij, ik, il, jk, jl, and kl in NEIGHBORS::LIST_MB_PAIRS.
+		
+		// Resolved per frame by Cheby::type_4b_interactions and Cheby::cache_4b_pairs.
+		
+		int type;          // Quadruplet type index, or -1 if excluded.
+		int vstart;        // First column of the quadruplet type, relative to the first 4-body column.
+		int pair_type[6];  // Pair type of ij, ik, il, jk, jl, and kl.
+		int pair_idx[6];   // Pair index of ij, ik, il, jk, jl, and kl within the quadruplet type.
+		
+		int entry[6];      // Cheby pair cache entry of ij, ik, il, jk, jl, and kl.
 };
   
 class NEIGHBORS
@@ -456,17 +533,57 @@ private:
 	 bool   SECOND_CALL;						// Is this the second call? If so, pick the padding distance.
 	 double DISPLACEMENT;
 	 double SAFETY;                 					// Safety factor in calculating neighbors.
+
+	 // Persistent bins for DO_UPDATE_BIG, kept as doubly linked lists through the ALL_ATOMS index.
+
+	 bool        KEEP_BINS;					// Reuse the bin grid between updates? If false, bins from scratch each time.
+	 double      BIN_SIZE;					// Bin width.
+	 XYZ         BIN_LOW;					// Lower corner of the occupied bins (there is one empty layer below).
+	 XYZ_INT     NBINS;					// Number of bins along x, y and z, including the empty layers.
+	 vector<int> BIN_HEAD;					// First atom in each bin, or -1.
+	 vector<int> BIN_NEXT;					// Next atom in the same bin, or -1.
+	 vector<int> BIN_PREV;					// Previous atom in the same bin, or -1.
+	 vector<int> ATOM_BIN;					// Bin of each atom, or -1 if not binned.
+		
+	 int  FIND_BIN       (XYZ & POS, bool INTERIOR);
+	 void ADD_TO_BIN     (int ATOM, int BIN);
+	 void REMOVE_FROM_BIN(int ATOM);
+	 void BUILD_BIN_GRID (FRAME & SYSTEM, double SEARCH_DIST);
+	 bool REBIN_ATOMS    (FRAME & SYSTEM, bool FROM_SCRATCH);
+
+	 // Adaptive padding (AUTO_SKIN).
+
+	 vector<XYZ> BUILD_COORDS;				// Positions of the local atoms at the last build.
+	 double      BUILD_CELL[9];				// Cell vectors at the last build.
+	 double      SKIN_BUILD_TIME;				// Wall time of the last build (s).
+	 double      SKIN_STEP_TIME;				// Wall time of the steps since the last build, excluding the build (s).
+	 int         SKIN_STEPS;				// Steps since the last build.
+	 chrono::steady_clock::time_point SKIN_LAST_CALL;	// End of the previous UPDATE_LIST call.
+	 double      SKIN_SAMPLE_TIME;				// Wall time of the steps and builds at the current padding (s).
+	 int         SKIN_SAMPLE_STEPS;				// Steps at the current padding.
+	 double      SKIN_LAST_COST;				// Cost per step at the previous padding (s), or 0.
+	 double      SKIN_LOG_STEP;				// Log of the factor applied to the padding at the next change.
+
+	 double PAIR_DRIFT(FRAME & SYSTEM, JOB_CONTROL & CONTROLS);
+	 void   TUNE_SKIN ();
 		
 	 void FIX_LAYERS(FRAME & SYSTEM, JOB_CONTROL & CONTROLS);	// Updates ghost atoms based on pbc-wrapped real atoms
 	 void DO_UPDATE_SMALL (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);	// Builds and/or updates neighbor list
 	 void DO_UPDATE_BIG   (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);	// Builds and/or updates neighbor list
+	 void DO_UPDATE_CELLS (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);	// As DO_UPDATE_BIG, binning real atoms only
 	 void UPDATE_3B_INTERACTION(FRAME & SYSTEM, JOB_CONTROL &CONTROLS);  // Update 3-Body interaction list.
 	 void UPDATE_4B_INTERACTION(FRAME & SYSTEM, JOB_CONTROL &CONTROLS);  // Update 4-Body interaction list.
 
+	 unordered_map<long long, int> MB_PAIR_MAP;	// (a1, a2) -> index in LIST_MB_PAIRS
+	 int  MB_PAIR(FRAME & SYSTEM, int A1, int A2);	// Index of the pair in LIST_MB_PAIRS, adding it if needed.
+
 public:
 
 	 bool   UPDATE_WITH_BIG;			// Should we update our neighbor list with DO_UPDATE_BIG? If false, uses DO_UPDATE_SMALL
+	 bool   UPDATE_WITH_CELLS;		// If UPDATE_WITH_BIG, use DO_UPDATE_CELLS instead when ghost atoms are present
+	 class DOMAINS * DECOMP;		// Domain decomposition, if any. Lists then only cover atoms owned by this process.
 	 double RCUT_PADDING;			// Neighborlist cutoff is r_max + rcut_padding
+	 bool   AUTO_SKIN;			// Rebuild on measured displacements and tune RCUT_PADDING from measured costs, instead of using UPDATE_FREQ?
 	 bool   USE;				// Do we even want to use a neighbor list?
 	 double CURR_VEL;
 	 double MAX_VEL;
@@ -487,6 +604,7 @@ public:
 
 	 vector<INTERACTION_3B> LIST_3B_INT;    // A flat list of all 3-body interactions.
 	 vector<INTERACTION_4B> LIST_4B_INT;    // A flat list of all 3-body interactions.
+	 vector<INTERACTION_PAIR> LIST_MB_PAIRS; // The distinct atom pairs of LIST_3B_INT and LIST_4B_INT.
 
 	 void UPDATE_LIST(FRAME & SYSTEM, JOB_CONTROL & CONTROLS);	// Will check if lists need updating, and will call DO_UPDATE do so if need be
 	 //void UPDATE_LIST(FRAME & SYSTEM, JOB_CONTROL & CONTROLS, bool FORCE);
@@ -549,6 +667,16 @@ private:
 	 double N_DOF;		// # degrees of freedom
 	 double VSCALEH;		// Replaces 
 	 double KIN_ENER;	// Kinetic energy
+
+	 // r-RESPA slow terms from the last Force_split::SLOW evaluation
+
+	 vector<XYZ> RESPA_ACCEL;		// Slow accelerations
+	 double      RESPA_ENER;		// Slow potential energy
+	 double      RESPA_PRESS;		// Slow virial pressure
+	 vector<XYZ> RESPA_PRESS_TENSOR;	// Slow virial stress tensor
+	 int         RESPA_STEPS;		// Inner steps in the current outer step
+
+	 void respa_kick(FRAME & SYSTEM, JOB_CONTROL & CONTROLS, vector<XYZ> & VELOC);
 			
 public:
 		
@@ -569,6 +697,11 @@ public:
 	 void SCALE_VELOCITIES    (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);
 	 void UPDATE_TEMPERATURE  (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);
 	 double CONSERVED_QUANT   (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);
+
+	 void RESPA_STORE_SLOW    (FRAME & SYSTEM);					// Keep the forces, energy and virial of a slow evaluation.
+	 void RESPA_ADD_SLOW      (FRAME & SYSTEM);					// Add the kept slow energy and virial to the current totals.
+	 void RESPA_OPEN          (FRAME & SYSTEM, JOB_CONTROL & CONTROLS, int STEPS);	// Start an outer step of STEPS inner steps: half kick VELOCITY with the slow forces.
+	 void RESPA_CLOSE         (FRAME & SYSTEM, JOB_CONTROL & CONTROLS);		// End the outer step: half kick VELOCITY_ITER with the new slow forces.
 		
 	 CONSTRAINT();
 	 ~CONSTRAINT();
@@ -619,6 +752,7 @@ public:
 //////////////////////////////////////////
 
 void divide_atoms(int &a1start, int &a1end, int atoms);
+void divide_atoms(int &a1start, int &a1end, int atoms, const NEIGHBORS & NEIGHBOR_LIST);
 
 
 //////////////////////////////////////////
@@ -633,10 +767,12 @@ void ZCalc_Deriv (JOB_CONTROL & CONTROLS, vector<PAIRS> & FF_2BODY,  CLUSTER_LIS
 
 void SubtractEwaldForces (FRAME &SYSTEM, NEIGHBORS &NEIGHBOR_LIST, JOB_CONTROL &CONTROLS);
 
-void ZCalc_Ewald         (FRAME & TRAJECTORY, JOB_CONTROL & CONTROLS, NEIGHBORS & NEIGHBOR_LIST);
+void ZCalc_Ewald         (FRAME & TRAJECTORY, JOB_CONTROL & CONTROLS, NEIGHBORS & NEIGHBOR_LIST, Force_split PART = Force_split::ALL);
 
 void optimal_ewald_params(double accuracy, int nat, double &alpha, double & rc, int & kc, double & r_acc, double & k_acc, BOX boxdim);
 
+void optimal_pme_mesh    (double accuracy, double alpha, int order, BOX & boxdim, int mesh[3]);
+
 void ZCalc_Ewald_Deriv(FRAME & FRAME_TRAJECTORY, vector<PAIRS> & ATOM_PAIRS, A_MAT & A_MATRIX, map<string,int> & PAIR_MAP,NEIGHBORS & NEIGHBOR_LIST, JOB_CONTROL & CONTROLS) ;
 
 //////////////////////////////////////////
@@ -645,7 +781,7 @@ void ZCalc_Ewald_Deriv(FRAME & FRAME_TRAJECTORY, vector<PAIRS> & ATOM_PAIRS, A_M
 //
 //////////////////////////////////////////
 
-void   ZCalc(FRAME & SYSTEM, JOB_CONTROL & CONTROLS, vector<PAIR_FF> & FF_2BODY, map<string,int> &PAIR_MAP, vector<int> &INT_PAIR_MAP, CLUSTER_LIST& TRIPS, CLUSTER_LIST &QUADS,  NEIGHBORS & NEIGHBOR_LIST);
+void   ZCalc(FRAME & SYSTEM, JOB_CONTROL & CONTROLS, vector<PAIR_FF> & FF_2BODY, map<string,int> &PAIR_MAP, vector<int> &INT_PAIR_MAP, CLUSTER_LIST& TRIPS, CLUSTER_LIST &QUADS,  NEIGHBORS & NEIGHBOR_LIST, Force_split PART = Force_split::ALL);
 
 //////////////////////////////////////////
 // Distance calculation and smoothing functions
@@ -688,6 +824,18 @@ double VECTOR_ANGLE(vector<double> & v1, vector<double> & v2);
 
 void OPEN_TRAJFILE(ifstream & TRAJ_INPUT, vector<string> & INFILE, int FILE_IDX);
 
+// Location of one frame in the trajectory files, so that it can be read without reading the frames before it.
+
+struct TRAJ_FRAME
+{
+	int       FILE_IDX;	// Index of the trajectory file in CONTROLS.INFILE
+	long long OFFSET;	// Byte offset of the frame's atom count line
+	int       ATOMS;
+	double    VOLUME;	// Box volume from the frame header
+};
+
+void INDEX_TRAJFILE(vector<string> & INFILE, vector<int> & INFILE_FRAMES, vector<TRAJ_FRAME> & FRAMES);
+
 double kinetic_energy(FRAME & SYSTEM, JOB_CONTROL & CONTROLS, vector<XYZ> &Ktensor);			// Overloaded.. compute differentely if for main or new velocities
 double kinetic_energy(FRAME & SYSTEM, string TYPE, JOB_CONTROL & CONTROLS);	// Overloaded.. compute differentely if for main or new velocities
 
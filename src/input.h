@@ -89,6 +89,7 @@ private:	// private funcitons
 	void PARSE_CONTROLS_NFRAMES(JOB_CONTROL & CONTROLS);
 	//void PARSE_CONTROLS_NLAYERS(JOB_CONTROL & CONTROLS); // JUST USE THE MD VERSION... IT SHOULD BE COMPATIBLE
 	void PARSE_CONTROLS_FITCOUL(JOB_CONTROL & CONTROLS);
+	void PARSE_CONTROLS_USE_PME(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_FITSTRS(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_FITENER(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_PAIRTYP(JOB_CONTROL & CONTROLS);
@@ -96,6 +97,8 @@ private:	// private funcitons
 	void PARSE_CONTROLS_CHEBYFIX(JOB_CONTROL & CONTROLS) ;
 	void PARSE_CONTROLS_SERIAL_CHIMES(JOB_CONTROL & CONTROLS)	;
 	void PARSE_CONTROLS_SKIP_FRAMES(JOB_CONTROL &CONTROLS) ;
+	void PARSE_CONTROLS_AMATFMT(JOB_CONTROL &CONTROLS) ;
+	void PARSE_CONTROLS_FRMSCHD(JOB_CONTROL &CONTROLS) ;
 	
 	// For assigning LSQ variables: "Topology Variables" 
 	
@@ -136,6 +139,8 @@ private:	// private funcitons
 	void PARSE_CONTROLS_KILLLEN(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_NLAYERS(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_USENEIG(JOB_CONTROL & CONTROLS, NEIGHBORS & NEIGHBOR_LIST);
+	void PARSE_CONTROLS_AUTOSKN(NEIGHBORS & NEIGHBOR_LIST);
+	void PARSE_CONTROLS_DOMDCMP(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_PRMFILE(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_CRDFILE(JOB_CONTROL & CONTROLS);
 	
@@ -143,6 +148,7 @@ private:	// private funcitons
 	
 	void PARSE_CONTROLS_VELINIT(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_CONSRNT(JOB_CONTROL & CONTROLS);
+	void PARSE_CONTROLS_RESPA  (JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_PRSCALC(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_STRSCALC(JOB_CONTROL & CONTROLS);
 	void PARSE_CONTROLS_WRPCRDS(JOB_CONTROL & CONTROLS);
@@ -0,0 +1,51 @@
+import sys
+import os
+import numpy
+
+# Print an A matrix written in any # AMATFMT # style as text, so the outputs
+# can be compared against the TEXT A.txt and b.txt with compare.pl.
+#
+#   amat_to_text.py A.bin    A.txt b.txt      binary or sparse container
+#   amat_to_text.py gram.bin gram.txt         normal equation file
+#   amat_to_text.py A.txt b.txt gram.txt      normal equations from a TEXT run
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "../../src"))
+
+from chimes_lsq import is_binary_amat, is_sparse_amat, is_gram_file
+from chimes_lsq import read_binary_amat, read_sparse_amat, read_gram_file
+
+def write_matrix(fname, A):
+    with open(fname, "w") as f:
+        for row in A:
+            f.write("   ".join("%.16e" % v for v in row) + "\n")
+
+def write_vector(fname, b):
+    with open(fname, "w") as f:
+        for v in b:
+            f.write("%.16e\n" % v)
+
+def write_gram(fname, ATA, ATb, btb, nrows):
+    with open(fname, "w") as f:
+        f.write("nrows %d\n" % nrows)
+        f.write("btb %.16e\n" % btb)
+        for i in range(0, len(ATb)):
+            f.write("   ".join("%.16e" % v for v in ATA[i]) + "   %.16e\n" % ATb[i])
+
+if len(sys.argv) == 3 and is_gram_file(sys.argv[1]):
+    ATA, ATb, btb, nrows = read_gram_file(sys.argv[1])
+    write_gram(sys.argv[2], ATA, ATb, btb, nrows)
+elif len(sys.argv) == 4 and is_binary_amat(sys.argv[1]):
+    A, b, labels = read_binary_amat(sys.argv[1])
+    write_matrix(sys.argv[2], A)
+    write_vector(sys.argv[3], b)
+elif len(sys.argv) == 4 and is_sparse_amat(sys.argv[1]):
+    A, b, labels = read_sparse_amat(sys.argv[1])
+    write_matrix(sys.argv[2], A)
+    write_vector(sys.argv[3], b)
+elif len(sys.argv) == 4:
+    A = numpy.loadtxt(sys.argv[1], ndmin=2)
+    b = numpy.loadtxt(sys.argv[2], ndmin=1)
+    write_gram(sys.argv[3], A.T.dot(A), A.T.dot(b), b.dot(b), A.shape[0])
+else:
+    print ("Usage: amat_to_text.py <A.bin> <A.txt> <b.txt> | <gram.bin> <gram.txt> | <A.txt> <b.txt> <gram.txt>")
+    exit(1)